@@ -37,6 +37,9 @@
  *   Very practical advice on using SECCOMP.
  */
 
+/* for dl_iterate_phdr */
+#define _GNU_SOURCE
+
 #include <unistd.h>
 #include <fcntl.h>
 #include <dlfcn.h>
@@ -47,6 +50,10 @@
 #include <sys/prctl.h>
 #include <sys/syscall.h>
 #include <sys/mman.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <link.h>
+#include <unwind.h>
 
 /* Default heap size is 8MB */
 #define DEFAULT_HEAP_SIZE 8388608
@@ -56,6 +63,24 @@
 #define EXIT_FAILED    122  /* should not happen */
 #define MMAP_FAILED    123
 
+/* Size of the alternate signal stack used by the crash handler */
+#define CRASH_STACK_SIZE 65536
+
+/* Maximum number of return addresses in a crash report */
+#define MAX_CRASH_FRAMES 64
+
+/* Minimum size of the guard region below the preallocated stack.
+ * Like the gap the kernel leaves below the normal stack, it is large
+ * enough that a function whose frame (e.g., with large local arrays)
+ * is smaller than this can't step over it without touching it.
+ * Larger frames can still skip past it. */
+#define STACK_GUARD_SIZE 1048576
+
+/* Architectures on which main can be run on a preallocated stack */
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+#define HAVE_STACK_SWITCH 1
+#endif
+
 /* We implement our own atexit and __cxa_atexit. */
 struct CxaAtexitHandler {
 	union {
@@ -81,6 +106,11 @@ static void (*real_rtld_fini)(void);
 static void wrapper_fini(void);
 static void wrapper_rtld_fini(void);
 
+#ifdef HAVE_STACK_SWITCH
+/* Prototype for the entry point on the preallocated stack */
+static void stack_main(void);
+#endif
+
 /* Keep track of whether destructor functions have been run. */
 static int s_ran_fini;
 static int s_ran_rtld_fini;
@@ -96,6 +126,50 @@ static char *s_heap;
 static size_t s_heapsize;
 static char *s_brk;
 
+/*
+ * High-water mark of the heap (bytes handed out by sbrk), whether
+ * sbrk ever failed because the heap was full, and the file descriptor
+ * (from EASYSANDBOX_STATSFD) to which these are reported on exit,
+ * or -1 if no report was requested.
+ * Used by mkoracle.sh to calibrate per-test heap sizes.
+ */
+static size_t s_heappeak;
+static int s_heapfull;
+static int s_statsfd = -1;
+
+/*
+ * Interactive mode (EASYSANDBOX_INTERACTIVE): stdin and stdout are
+ * pipes to a judge program, so they get static buffers and stdout
+ * is line buffered.
+ */
+static int s_interactive;
+static char s_stdin_buf[BUFSIZ];
+static char s_stdout_buf[BUFSIZ];
+
+/*
+ * Alternate signal stack for the crash handler, so that it can
+ * run even if the program crashed by overflowing its stack,
+ * and the bounds and load bias of the executable, so that
+ * crash reports can give addresses usable with addr2line.
+ */
+static char s_crash_stack[CRASH_STACK_SIZE];
+static ElfW(Addr) s_exe_bias;
+static ElfW(Addr) s_exe_start, s_exe_end;
+
+/*
+ * Preallocated stack (EASYSANDBOX_STACKSIZE) on which main is run,
+ * so that deeply recursive programs are not limited by the size of
+ * the initial stack.  s_stack_top is null if main runs on the
+ * initial stack.  The arguments to main are saved so that they can
+ * be passed to it after switching stacks.
+ */
+#ifdef HAVE_STACK_SWITCH
+static char *s_stack_top;
+static int s_main_argc;
+static char **s_main_argv;
+static char **s_main_envp;
+#endif
+
 /*
  * Custom implementation of sbrk() that allocates from a fixed-size
  * array of bytes.  This avoids the need for malloc/free and
@@ -114,14 +188,38 @@ void *sbrk(intptr_t incr)
 	remaining = s_heapsize - used;
 	
 	if (remaining < incr) {
+		s_heapfull = 1;
 		errno = ENOMEM;
 		return (void*) -1;
 	}
 	newbrk = s_brk;
 	s_brk += incr;
+	if ((size_t) (s_brk - s_heap) > s_heappeak) {
+		s_heappeak = s_brk - s_heap;
+	}
 	return newbrk;
 }
 
+/*
+ * Report resource usage statistics on the stats file descriptor,
+ * if one was requested.  Only uses the write system call, so this
+ * is safe to call in SECCOMP mode.
+ */
+static void write_stats(void)
+{
+	char buf[64];
+	int len;
+
+	if (s_statsfd < 0) {
+		return;
+	}
+	len = snprintf(buf, sizeof(buf), "heappeak %lu\nheapfull %d\n",
+		(unsigned long) s_heappeak, s_heapfull);
+	if (len > 0) {
+		write(s_statsfd, buf, len);
+	}
+}
+
 /*
  * Re-implementation of exit.
  * Flushes stdout and stderr, and exits using the exit system
@@ -153,6 +251,9 @@ void exit(int exit_code)
 	fflush(stdout);
 	fflush(stderr);
 
+	/* Report heap usage, if requested */
+	write_stats();
+
 	/* The loop is because gcc doesn't know that syscall doesn't return
 	 * in this particular case */
 	while (1) {
@@ -160,6 +261,311 @@ void exit(int exit_code)
 	}
 }
 
+/*
+ * Write a string to stderr.  Only uses the write system call.
+ */
+static void crash_puts(const char *str)
+{
+	write(2, str, strlen(str));
+}
+
+/*
+ * Print one frame of a crash backtrace: addresses in the executable
+ * are printed relative to its load bias, others as absolute addresses.
+ */
+static void crash_print_frame(int frame, uintptr_t pc)
+{
+	char buf[64];
+
+	if (pc >= s_exe_start && pc < s_exe_end) {
+		snprintf(buf, sizeof(buf), "  #%d exe+0x%lx\n", frame, (unsigned long) (pc - s_exe_bias));
+	} else {
+		snprintf(buf, sizeof(buf), "  #%d 0x%lx\n", frame, (unsigned long) pc);
+	}
+	crash_puts(buf);
+}
+
+/* State passed to crash_unwind_frame */
+struct CrashUnwindState {
+	int frames;
+	int in_program; /* set once the unwinder has passed the sandbox's own frames */
+	uintptr_t anchor; /* if nonzero, start of the last function to skip */
+};
+
+/*
+ * Callback for _Unwind_Backtrace.  Frames belonging to the crash handler
+ * itself are skipped.  If the state has an anchor, they end with the
+ * anchor function's frame.  Otherwise, the interrupted frame is the first
+ * one whose IP is exact (not a return address), which the unwinder only
+ * reports for a frame interrupted by a signal.
+ */
+static _Unwind_Reason_Code crash_unwind_frame(struct _Unwind_Context *ctx, void *arg)
+{
+	struct CrashUnwindState *state = arg;
+	int ip_before_insn = 0;
+	uintptr_t pc;
+
+	pc = (uintptr_t) _Unwind_GetIPInfo(ctx, &ip_before_insn);
+	if (pc == 0) {
+		return _URC_END_OF_STACK;
+	}
+	if (!state->in_program) {
+		if (state->anchor != 0) {
+			if (_Unwind_GetRegionStart(ctx) == state->anchor) {
+				state->in_program = 1;
+			}
+			return _URC_NO_REASON;
+		}
+		if (!ip_before_insn) {
+			return _URC_NO_REASON;
+		}
+		state->in_program = 1;
+	}
+	if (!ip_before_insn) {
+		/* return addresses point after the call: back up into it */
+		pc--;
+	}
+	crash_print_frame(state->frames, pc);
+	state->frames++;
+#ifdef HAVE_STACK_SWITCH
+	if (_Unwind_GetRegionStart(ctx) == (uintptr_t) stack_main) {
+		/* bottom of the preallocated stack: there is nothing beyond */
+		return _URC_END_OF_STACK;
+	}
+#endif
+	return (state->frames < MAX_CRASH_FRAMES) ? _URC_NO_REASON : _URC_END_OF_STACK;
+}
+
+/*
+ * Name of a signal caught by the crash handler.  (strsignal may
+ * need to load locale data, which requires system calls.)
+ */
+static const char *crash_signal_name(int sig)
+{
+	switch (sig) {
+	case SIGSEGV: return "SIGSEGV";
+	case SIGBUS:  return "SIGBUS";
+	case SIGFPE:  return "SIGFPE";
+	case SIGABRT: return "SIGABRT";
+	default:      return "unknown signal";
+	}
+}
+
+/*
+ * Print a backtrace of the program's frames to stderr.  Returns the
+ * number of frames printed.  See crash_unwind_frame for the meaning
+ * of anchor.
+ */
+static int crash_backtrace(uintptr_t anchor)
+{
+	struct CrashUnwindState state;
+
+	state.frames = 0;
+	state.in_program = 0;
+	state.anchor = anchor;
+	_Unwind_Backtrace(crash_unwind_frame, &state);
+	return state.frames;
+}
+
+/*
+ * Get the interrupted PC from the signal context, and, if it is 0, the
+ * return address of the call that led to it.  This is used when the
+ * unwinder can't get past the interrupted frame.  A PC of 0 means the
+ * program called through a null function pointer, so the call has just
+ * left its return address at the top of the stack (or, on AArch64, in
+ * the link register).  For any other PC, the stack pointer may be what
+ * caused the crash, so the stack isn't read.  Returns the number of
+ * addresses found: 2, 1, or 0 if the architecture isn't supported.
+ */
+static int crash_context_frames(void *uctx, uintptr_t *pc, uintptr_t *ret)
+{
+	ucontext_t *uc = uctx;
+#if defined(__x86_64__)
+	*pc = (uintptr_t) uc->uc_mcontext.gregs[REG_RIP];
+	if (*pc != 0) {
+		return 1;
+	}
+	*ret = *(uintptr_t *) uc->uc_mcontext.gregs[REG_RSP];
+	return 2;
+#elif defined(__i386__)
+	*pc = (uintptr_t) uc->uc_mcontext.gregs[REG_EIP];
+	if (*pc != 0) {
+		return 1;
+	}
+	*ret = *(uintptr_t *) uc->uc_mcontext.gregs[REG_ESP];
+	return 2;
+#elif defined(__aarch64__)
+	*pc = (uintptr_t) uc->uc_mcontext.pc;
+	if (*pc != 0) {
+		return 1;
+	}
+	*ret = (uintptr_t) uc->uc_mcontext.regs[30];
+	return 2;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Exit after a crash has been reported, with the same exit code a
+ * shell would report for death by the given signal.
+ */
+static void crash_exit(int sig) __attribute__((noreturn));
+
+static void crash_exit(int sig)
+{
+	write_stats();
+
+	while (1) {
+		syscall(SYS_exit, 128 + sig);
+	}
+}
+
+/*
+ * Handler for fatal signals.  Flushes stdout and stderr, prints
+ * the signal, the faulting address, and a backtrace to stderr,
+ * and exits (using the exit system call, as with exit) with the
+ * same exit code a shell would report for death by the signal.
+ */
+static void crash_handler(int sig, siginfo_t *info, void *uctx)
+{
+	char buf[96];
+	uintptr_t pc, ret;
+
+	fflush(stdout);
+	fflush(stderr);
+
+	snprintf(buf, sizeof(buf), "<<caught signal %d (%s), fault address %p>>\n",
+		sig, crash_signal_name(sig), info->si_addr);
+	crash_puts(buf);
+
+	if (crash_backtrace(0) == 0) {
+		switch (crash_context_frames(uctx, &pc, &ret)) {
+		case 2:
+			crash_print_frame(0, pc);
+			crash_print_frame(1, ret - 1);
+			break;
+		case 1:
+			crash_print_frame(0, pc);
+			break;
+		}
+	}
+
+	crash_exit(sig);
+}
+
+/*
+ * Flush stdout and stderr, and print a report for a call to abort
+ * (or a failed assertion) to stderr.  The backtrace starts with the
+ * caller of the anchor function.
+ */
+static void crash_report_abort(uintptr_t anchor)
+{
+	fflush(stdout);
+	fflush(stderr);
+
+	crash_puts("<<called abort>>\n");
+	crash_backtrace(anchor);
+}
+
+/*
+ * Re-implementation of abort.
+ * glibc's abort is unusable in SECCOMP mode because it unblocks
+ * and raises SIGABRT using system calls, so the process would be
+ * killed before the crash handler could report anything.
+ * Instead, report the crash directly and exit as the crash
+ * handler would for SIGABRT.
+ */
+void abort(void)
+{
+	crash_report_abort((uintptr_t) abort);
+	crash_exit(SIGABRT);
+}
+
+/*
+ * Re-implementation of __assert_fail, which assert calls when
+ * an assertion fails.  glibc's version calls its internal abort
+ * directly, bypassing our abort, so it has to be replaced too.
+ * The message is the same as glibc's.
+ */
+void __assert_fail(const char *assertion, const char *file, unsigned int line, const char *function)
+{
+	fflush(stdout);
+	fprintf(stderr, "%s: %s:%u: %s%sAssertion `%s' failed.\n",
+		program_invocation_short_name, file, line,
+		(function != 0) ? function : "", (function != 0) ? ": " : "",
+		assertion);
+	crash_report_abort((uintptr_t) __assert_fail);
+	crash_exit(SIGABRT);
+}
+
+/*
+ * Callback for dl_iterate_phdr: the first object is the executable.
+ */
+static int find_exe_bounds(struct dl_phdr_info *info, size_t size, void *arg)
+{
+	int i;
+
+	s_exe_bias = info->dlpi_addr;
+	s_exe_start = (ElfW(Addr)) -1;
+	s_exe_end = 0;
+	for (i = 0; i < info->dlpi_phnum; i++) {
+		const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+		if (phdr->p_type != PT_LOAD) {
+			continue;
+		}
+		if (info->dlpi_addr + phdr->p_vaddr < s_exe_start) {
+			s_exe_start = info->dlpi_addr + phdr->p_vaddr;
+		}
+		if (info->dlpi_addr + phdr->p_vaddr + phdr->p_memsz > s_exe_end) {
+			s_exe_end = info->dlpi_addr + phdr->p_vaddr + phdr->p_memsz;
+		}
+	}
+	return 1; /* stop after the executable */
+}
+
+/*
+ * Callback used to exercise the unwinder before entering SECCOMP mode.
+ */
+static _Unwind_Reason_Code crash_unwind_nop(struct _Unwind_Context *ctx, void *arg)
+{
+	return _URC_NO_REASON;
+}
+
+/*
+ * Install the crash handler for fatal signals on an alternate stack.
+ * Must be called before entering SECCOMP mode.
+ */
+static void install_crash_handler(void)
+{
+	static const int signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGABRT };
+	stack_t ss;
+	struct sigaction sa;
+	unsigned i;
+
+	dl_iterate_phdr(find_exe_bounds, 0);
+
+	/* Run the unwinder once now, so that any lazy initialization
+	 * it (or the dynamic linker on its behalf) needs is done before
+	 * system calls are forbidden. */
+	_Unwind_Backtrace(crash_unwind_nop, 0);
+
+	ss.ss_sp = s_crash_stack;
+	ss.ss_size = sizeof(s_crash_stack);
+	ss.ss_flags = 0;
+	if (sigaltstack(&ss, 0) != 0) {
+		return;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = crash_handler;
+	sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+	sigemptyset(&sa.sa_mask);
+	for (i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+		sigaction(signals[i], &sa, 0);
+	}
+}
+
 #define IMPL_ATEXIT(func_,field_,arg_,type_) \
 	struct CxaAtexitHandler *handler; \
 	if (s_atexit_handler_count >= MAX_ATEXIT_HANDLERS) { \
@@ -195,31 +601,49 @@ static void wrapper_init(void)
 	int stdin_flags;
 	int c;
 
-	/* The first call to print to a stream will cause glibc to
-	 * invoke the fstat system call, which will cause SECCOMP
-	 * to kill the process. There does not seem to be any way
-	 * of working around this problem except to print some output
-	 * on the stdout and strerr streams before entering SECCOMP mode.
-	 * Unfortunately, a printf call that generates no output doesn't
-	 * work, so some extraneous output seems unavoidable. Fortunately,
-	 * this is easy to filter out as a post-processing step. */
-	fprintf(stdout, "<<entering SECCOMP mode>>\n");
-	fflush(stdout);
-	fprintf(stderr, "<<entering SECCOMP mode>>\n");
-	fflush(stderr);
-
-	/* The first call to read from stdin will also result in a
-	 * call to fstat.  Work around this by setting the stdin
-	 * file descriptor to nonblocking, then reading a single character
-	 * from stdin. */
-	stdin_flags = fcntl(0, F_GETFL, 0);
-	fcntl(0, F_SETFL, stdin_flags | O_NONBLOCK); /* make stdin nonblocking */
-	c = fgetc(stdin);
-	if (c != EOF) {
-		/* We read a character, so put it back */
-		ungetc(c, stdin);
+	if (s_interactive) {
+		/* In interactive mode, stdin and stdout are connected to
+		 * a judge program, so writing a message to stdout would
+		 * confuse it, and the nonblocking stdin probe below could
+		 * race with its first line.  Instead, give both streams
+		 * static buffers: glibc only calls fstat to allocate a
+		 * stream's buffer, so neither is needed.  Make stdout line
+		 * buffered so that each line reaches the judge immediately
+		 * (glibc would otherwise fully buffer a pipe). */
+		setvbuf(stdin, s_stdin_buf, _IOFBF, sizeof(s_stdin_buf));
+		setvbuf(stdout, s_stdout_buf, _IOLBF, sizeof(s_stdout_buf));
+		fprintf(stderr, "<<entering SECCOMP mode>>\n");
+		fflush(stderr);
+	} else {
+		/* The first call to print to a stream will cause glibc to
+		 * invoke the fstat system call, which will cause SECCOMP
+		 * to kill the process. There does not seem to be any way
+		 * of working around this problem except to print some output
+		 * on the stdout and strerr streams before entering SECCOMP mode.
+		 * Unfortunately, a printf call that generates no output doesn't
+		 * work, so some extraneous output seems unavoidable. Fortunately,
+		 * this is easy to filter out as a post-processing step. */
+		fprintf(stdout, "<<entering SECCOMP mode>>\n");
+		fflush(stdout);
+		fprintf(stderr, "<<entering SECCOMP mode>>\n");
+		fflush(stderr);
+
+		/* The first call to read from stdin will also result in a
+		 * call to fstat.  Work around this by setting the stdin
+		 * file descriptor to nonblocking, then reading a single character
+		 * from stdin. */
+		stdin_flags = fcntl(0, F_GETFL, 0);
+		fcntl(0, F_SETFL, stdin_flags | O_NONBLOCK); /* make stdin nonblocking */
+		c = fgetc(stdin);
+		if (c != EOF) {
+			/* We read a character, so put it back */
+			ungetc(c, stdin);
+		}
+		fcntl(0, F_SETFL, stdin_flags); /* restore original stdin flags */
 	}
-	fcntl(0, F_SETFL, stdin_flags); /* restore original stdin flags */
+
+	/* Catch crashes so that they can be reported */
+	install_crash_handler();
 
 #if 1
 	/* Enter SECCOMP mode */
@@ -232,6 +656,142 @@ static void wrapper_init(void)
 	real_init();
 }
 
+#ifdef HAVE_STACK_SWITCH
+/*
+ * Entry point on the preallocated stack: calls the real main
+ * function, then exits.  Must not return, since there is no
+ * caller to return to.
+ */
+static void stack_main(void)
+{
+	exit(real_main(s_main_argc, s_main_argv, s_main_envp));
+}
+
+/*
+ * Trampoline at the bottom of the preallocated stack: clears the frame
+ * pointer and calls the function whose address is in the second argument
+ * register used by run_main_on_stack (rcx/ecx, or x1 on AArch64).
+ * Its CFI marks the return address as undefined, which tells any
+ * unwinder (including the one that propagates C++ exceptions) that this
+ * is the outermost frame, rather than letting it continue into the
+ * frames on the original stack.
+ */
+#if defined(__x86_64__)
+__asm__(
+	".pushsection .text\n"
+	".type easysandbox_stack_trampoline, %function\n"
+	"easysandbox_stack_trampoline:\n"
+	".cfi_startproc\n"
+	".cfi_undefined rip\n"
+	"	xor %ebp, %ebp\n"
+	"	call *%rcx\n"
+	"	hlt\n"
+	".cfi_endproc\n"
+	".size easysandbox_stack_trampoline, .-easysandbox_stack_trampoline\n"
+	".popsection\n");
+#elif defined(__i386__)
+__asm__(
+	".pushsection .text\n"
+	".type easysandbox_stack_trampoline, %function\n"
+	"easysandbox_stack_trampoline:\n"
+	".cfi_startproc\n"
+	".cfi_undefined eip\n"
+	"	xor %ebp, %ebp\n"
+	"	call *%ecx\n"
+	"	hlt\n"
+	".cfi_endproc\n"
+	".size easysandbox_stack_trampoline, .-easysandbox_stack_trampoline\n"
+	".popsection\n");
+#elif defined(__aarch64__)
+__asm__(
+	".pushsection .text\n"
+	".type easysandbox_stack_trampoline, %function\n"
+	"easysandbox_stack_trampoline:\n"
+	".cfi_startproc\n"
+	".cfi_undefined x29\n"
+	".cfi_undefined x30\n"
+	"	mov x29, xzr\n"
+	"	blr x1\n"
+	"	brk #0\n"
+	".cfi_endproc\n"
+	".size easysandbox_stack_trampoline, .-easysandbox_stack_trampoline\n"
+	".popsection\n");
+#endif
+
+/*
+ * Switch to the preallocated stack and call stack_main via the
+ * trampoline.  This can't be done with swapcontext, since it makes
+ * a system call (to set the signal mask), which isn't allowed in
+ * SECCOMP mode.  The operands are bound to the fixed registers the
+ * trampoline expects, which also keeps the compiler from choosing
+ * the frame pointer register (allocatable without frame pointers)
+ * that the trampoline clears.
+ */
+static void run_main_on_stack(void)
+{
+#if defined(__x86_64__)
+	__asm__ volatile(
+		"mov %0, %%rsp\n\t"
+		"jmp easysandbox_stack_trampoline"
+		: : "a" (s_stack_top), "c" (stack_main) : "memory");
+#elif defined(__i386__)
+	__asm__ volatile(
+		"mov %0, %%esp\n\t"
+		"jmp easysandbox_stack_trampoline"
+		: : "a" (s_stack_top), "c" (stack_main) : "memory");
+#elif defined(__aarch64__)
+	register char *top __asm__("x0") = s_stack_top;
+	register void (*fn)(void) __asm__("x1") = stack_main;
+	__asm__ volatile(
+		"mov sp, %0\n\t"
+		"b easysandbox_stack_trampoline"
+		: : "r" (top), "r" (fn) : "memory");
+#endif
+	__builtin_unreachable();
+}
+
+/*
+ * Allocate the stack on which main will run, with an inaccessible
+ * guard region (at least STACK_GUARD_SIZE bytes) at its low end so
+ * that overflowing it is caught as a SIGSEGV.  If prefault is set,
+ * every page is touched now so that the program never takes a page
+ * fault to grow its stack.
+ */
+static void alloc_stack(size_t stacksize, int prefault)
+{
+	size_t pagesize, guardsize, i;
+	char *stack;
+
+	pagesize = (size_t) sysconf(_SC_PAGESIZE);
+	stacksize = (stacksize + pagesize - 1) & ~(pagesize - 1);
+	guardsize = (STACK_GUARD_SIZE + pagesize - 1) & ~(pagesize - 1);
+
+	stack = mmap(0, guardsize + stacksize, PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_STACK, -1, 0);
+	if (stack == MAP_FAILED) {
+		_exit(MMAP_FAILED);
+	}
+	if (mprotect(stack, guardsize, PROT_NONE) != 0) {
+		_exit(MMAP_FAILED);
+	}
+
+#ifdef MADV_HUGEPAGE
+	/* Ask for transparent huge pages, to cut down on page faults
+	 * and TLB misses in deep recursion.  Failure is harmless. */
+	madvise(stack + guardsize, stacksize, MADV_HUGEPAGE);
+#endif
+
+	if (prefault) {
+		for (i = guardsize; i < guardsize + stacksize; i += pagesize) {
+			stack[i] = 0;
+		}
+	}
+
+	/* keep the initial stack pointer 16-byte aligned */
+	s_stack_top = stack + guardsize + stacksize - 16;
+}
+#endif /* HAVE_STACK_SWITCH */
+
 static int wrapper_main(int argc, char **argv, char **envp)
 {
 	/* Call the real main function.
@@ -239,6 +799,15 @@ static int wrapper_main(int argc, char **argv, char **envp)
 	 * because returning would cause glibc to invoke the exit_group
 	 * system call, which is not allowed in SECCOMP mode. */
 	int n;
+#ifdef HAVE_STACK_SWITCH
+	if (s_stack_top != 0) {
+		/* run main on the preallocated stack (does not return) */
+		s_main_argc = argc;
+		s_main_argv = argv;
+		s_main_envp = envp;
+		run_main_on_stack();
+	}
+#endif
 	n = real_main(argc, argv, envp);
 	exit(n);
 	return EXIT_FAILED;
@@ -275,6 +844,11 @@ int __libc_start_main(
 {
 	void *libc_handle;
 	const char *heapenv;
+	const char *statsenv;
+	const char *interactiveenv;
+#ifdef HAVE_STACK_SWITCH
+	const char *stackenv;
+#endif
 
 	int (*real_libc_start_main)(
 		int (*main) (int, char **, char **),
@@ -300,6 +874,25 @@ int __libc_start_main(
 		_exit(MMAP_FAILED);
 	}
 
+	/* See if the launcher wants heap usage statistics reported on exit */
+	statsenv = getenv("EASYSANDBOX_STATSFD");
+	if (statsenv != 0) {
+		s_statsfd = atoi(statsenv);
+	}
+
+	/* See if stdin and stdout are connected to an interactive judge */
+	interactiveenv = getenv("EASYSANDBOX_INTERACTIVE");
+	s_interactive = (interactiveenv != 0 && atoi(interactiveenv) != 0);
+
+#ifdef HAVE_STACK_SWITCH
+	/* Allocate a stack for main, if requested */
+	stackenv = getenv("EASYSANDBOX_STACKSIZE");
+	if (stackenv != 0 && atol(stackenv) > 0) {
+		const char *prefaultenv = getenv("EASYSANDBOX_STACKPREFAULT");
+		alloc_stack((size_t) atol(stackenv), prefaultenv != 0 && atoi(prefaultenv) != 0);
+	}
+#endif
+
 	/* explicitly open the glibc shared library */
 	libc_handle = dlopen("libc.so.6", RTLD_LOCAL | RTLD_LAZY);
 	if (libc_handle == 0) {
@@ -0,0 +1,283 @@
+/*
+ * EasySandbox: an extremely simple sandbox for untrusted C/C++ programs
+ * Copyright (c) 2012,2013 David Hovemeyer <david.hovemeyer@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Launcher for interactive problems.
+ *
+ * Usage: interact interactor [args...] -- exe [args...]
+ *
+ * Runs exe under EasySandbox (in interactive mode) and the interactor
+ * (unsandboxed), with the stdout of each connected to the stdin of the
+ * other.  The launcher relays the data between them so that it can
+ * measure the latency of each exchange: the time from a line written
+ * by the interactor to the next line written by exe.  A summary is
+ * printed to stderr when both programs have finished.
+ *
+ * The exit code is exe's exit code (128+signal if it was killed),
+ * or, if exe exited normally with code 0, the interactor's exit code.
+ *
+ * The location of the EasySandbox shared library can be set with the
+ * EASYSANDBOX_SO environment variable (default ./EasySandbox.so).
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define LAUNCH_FAILED 124
+
+/* One direction of the relay: data read from in_fd is written to out_fd. */
+struct Relay {
+	int in_fd;
+	int out_fd;
+};
+
+/* Latency statistics, in nanoseconds. */
+static long long s_exchanges;
+static long long s_total_latency;
+static long long s_max_latency;
+
+/* Time at which the interactor's last unanswered line was relayed, or -1. */
+static long long s_query_time = -1;
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Fork a child process running argv, with given file descriptors
+ * as its stdin and stdout.  All other pipe file descriptors in
+ * close_fds (terminated by -1) are closed in the child.
+ */
+static pid_t launch(char **argv, int in_fd, int out_fd, const int *close_fds, int sandboxed)
+{
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(LAUNCH_FAILED);
+	}
+	if (pid == 0) {
+		dup2(in_fd, 0);
+		dup2(out_fd, 1);
+		for (; *close_fds >= 0; close_fds++) {
+			close(*close_fds);
+		}
+		/* the launcher ignores SIGPIPE, but ignored signals
+		 * stay ignored across exec */
+		signal(SIGPIPE, SIG_DFL);
+		if (sandboxed) {
+			const char *so = getenv("EASYSANDBOX_SO");
+			setenv("LD_PRELOAD", (so != 0) ? so : "./EasySandbox.so", 1);
+			setenv("EASYSANDBOX_INTERACTIVE", "1", 1);
+		}
+		execvp(argv[0], argv);
+		perror(argv[0]);
+		_exit(LAUNCH_FAILED);
+	}
+	return pid;
+}
+
+/*
+ * Copy whatever data is available from a relay's input to its output.
+ * Returns 0 once the input has reached end of file.  If the output has
+ * been closed by the reader, the data is discarded.
+ */
+static int relay_data(struct Relay *relay, int from_interactor)
+{
+	char buf[4096];
+	ssize_t n, off, rc;
+
+	n = read(relay->in_fd, buf, sizeof(buf));
+	if (n < 0 && errno == EINTR) {
+		return 1;
+	}
+	if (n <= 0) {
+		return 0;
+	}
+
+	for (off = 0; off < n && relay->out_fd >= 0; off += rc) {
+		rc = write(relay->out_fd, buf + off, n - off);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				rc = 0;
+				continue;
+			}
+			/* reader is gone (EPIPE): drop the rest */
+			close(relay->out_fd);
+			relay->out_fd = -1;
+			break;
+		}
+	}
+
+	/* An exchange starts when the interactor completes a line,
+	 * and ends when exe completes a line in response. */
+	if (memchr(buf, '\n', n) != 0) {
+		if (from_interactor) {
+			if (s_query_time < 0) {
+				s_query_time = now_ns();
+			}
+		} else if (s_query_time >= 0) {
+			long long latency = now_ns() - s_query_time;
+			s_exchanges++;
+			s_total_latency += latency;
+			if (latency > s_max_latency) {
+				s_max_latency = latency;
+			}
+			s_query_time = -1;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Convert a wait status to a shell-style exit code.
+ */
+static int exit_code(int status)
+{
+	if (WIFSIGNALED(status)) {
+		return 128 + WTERMSIG(status);
+	}
+	return WEXITSTATUS(status);
+}
+
+int main(int argc, char **argv)
+{
+	int to_exe[2], from_exe[2];
+	int i, sep;
+	int pipe_fds[5];
+	pid_t interactor_pid, exe_pid;
+	int interactor_status, exe_status;
+	struct Relay relays[2];
+	struct pollfd pfds[2];
+
+	/* find the separator between the interactor and exe command lines */
+	sep = -1;
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--") == 0) {
+			sep = i;
+			break;
+		}
+	}
+	if (sep <= 1 || sep == argc - 1) {
+		fprintf(stderr, "Usage: %s interactor [args...] -- exe [args...]\n", argv[0]);
+		return LAUNCH_FAILED;
+	}
+	argv[sep] = 0;
+
+	/* The interactor and exe each get a pipe for their stdin
+	 * and one for their stdout; the launcher holds the other ends. */
+	signal(SIGPIPE, SIG_IGN);
+
+	if (pipe(to_exe) != 0 || pipe(from_exe) != 0) {
+		perror("pipe");
+		return LAUNCH_FAILED;
+	}
+	pipe_fds[0] = to_exe[0];
+	pipe_fds[1] = to_exe[1];
+	pipe_fds[2] = from_exe[0];
+	pipe_fds[3] = from_exe[1];
+	pipe_fds[4] = -1;
+	exe_pid = launch(&argv[sep + 1], to_exe[0], from_exe[1], pipe_fds, 1);
+	close(to_exe[0]);
+	close(from_exe[1]);
+	relays[1].in_fd = from_exe[0];
+	relays[0].out_fd = to_exe[1];
+
+	{
+		int to_int[2], from_int[2];
+		int fds[7];
+
+		if (pipe(to_int) != 0 || pipe(from_int) != 0) {
+			perror("pipe");
+			return LAUNCH_FAILED;
+		}
+		fds[0] = to_int[0];
+		fds[1] = to_int[1];
+		fds[2] = from_int[0];
+		fds[3] = from_int[1];
+		fds[4] = to_exe[1];
+		fds[5] = from_exe[0];
+		fds[6] = -1;
+		interactor_pid = launch(&argv[1], to_int[0], from_int[1], fds, 0);
+		close(to_int[0]);
+		close(from_int[1]);
+		relays[0].in_fd = from_int[0];
+		relays[1].out_fd = to_int[1];
+	}
+
+	/* relay data until both programs have closed their stdout */
+	while (relays[0].in_fd >= 0 || relays[1].in_fd >= 0) {
+		for (i = 0; i < 2; i++) {
+			pfds[i].fd = relays[i].in_fd;
+			pfds[i].events = POLLIN;
+			pfds[i].revents = 0;
+		}
+		if (poll(pfds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("poll");
+			break;
+		}
+		for (i = 0; i < 2; i++) {
+			if (pfds[i].revents == 0) {
+				continue;
+			}
+			if (!relay_data(&relays[i], i == 0)) {
+				/* end of file: pass it on to the other program */
+				close(relays[i].in_fd);
+				relays[i].in_fd = -1;
+				if (relays[i].out_fd >= 0) {
+					close(relays[i].out_fd);
+					relays[i].out_fd = -1;
+				}
+			}
+		}
+	}
+
+	waitpid(exe_pid, &exe_status, 0);
+	waitpid(interactor_pid, &interactor_status, 0);
+
+	fprintf(stderr, "<<interact: %lld exchanges, mean latency %lld us, max latency %lld us>>\n",
+		s_exchanges,
+		(s_exchanges > 0) ? s_total_latency / s_exchanges / 1000 : 0LL,
+		s_max_latency / 1000);
+
+	if (exit_code(exe_status) != 0) {
+		return exit_code(exe_status);
+	}
+	return exit_code(interactor_status);
+}
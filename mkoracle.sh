@@ -0,0 +1,168 @@
+#! /bin/bash
+
+# Generate oracle files by running a reference solution under EasySandbox.
+#
+# Usage: ./mkoracle.sh [-j jobs] [-m heapfactor] [-t timefactor] refexe [input...]
+#
+# For each input file foo.in, the reference solution is run with foo.in
+# on stdin, and foo.out (output) and foo.exit (exit code) are written
+# alongside it.  If no inputs are given, a single case named
+# oracle/<basename of refexe> is run, using oracle/<name>.in as stdin
+# if it exists (the layout expected by runtest.sh).
+#
+# Each case is also calibrated: the peak heap usage (as reported by
+# EasySandbox.so via EASYSANDBOX_STATSFD) times heapfactor is written to
+# foo.heapsize, and the CPU time (user+sys) times timefactor, rounded up
+# to whole seconds, is written to foo.timelimit.  Cases run in parallel,
+# which does not affect the CPU time measurements.
+#
+# If the reference solution exits with a code above 128 (usually meaning
+# it was killed by a signal) or runs out of heap, an error is reported for
+# that case, its existing oracle files (if any) are left alone, and the
+# script exits with status 1.  Inputs must be readable and end in .in.
+
+sandbox=`dirname $0`/EasySandbox.so
+jobs=`getconf _NPROCESSORS_ONLN`
+heapfactor=2
+timefactor=3
+
+# Heap size used for the calibration run; it just needs to be big enough.
+# Untouched pages are never faulted in, so this costs nothing.
+calibration_heapsize=${EASYSANDBOX_HEAPSIZE:-268435456}
+
+# The sandbox heap grows in units of this many bytes (see MIN_ALLOC in malloc.c)
+heap_granularity=65536
+
+# Minimum time limit in seconds
+min_timelimit=1
+
+while getopts "j:m:t:" opt; do
+	case $opt in
+	j) jobs=$OPTARG ;;
+	m) heapfactor=$OPTARG ;;
+	t) timefactor=$OPTARG ;;
+	*) echo "Usage: $0 [-j jobs] [-m heapfactor] [-t timefactor] refexe [input...]" >&2
+	   exit 1 ;;
+	esac
+done
+shift `expr $OPTIND - 1`
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 [-j jobs] [-m heapfactor] [-t timefactor] refexe [input...]" >&2
+	exit 1
+fi
+
+refexe=$1
+shift
+case ${refexe} in
+*/*) ;;
+*) refexe=./${refexe} ;;
+esac
+
+# Run the reference solution on one case and write its oracle files.
+# $1 is the case name (path without extension), $2 the file to use as stdin.
+# The oracle files are only written if the run succeeded, so an
+# existing oracle is kept if the reference solution fails.
+run_case() {
+	casename=$1
+	input=$2
+	stats=`mktemp`
+	times=`mktemp`
+	output=`mktemp`
+
+	# Time the sandboxed run: the time report is the last line
+	# written to the group's stderr (bash may also report a fatal signal)
+	TIMEFORMAT='%3U %3S'
+	{ time LD_PRELOAD=${sandbox} EASYSANDBOX_HEAPSIZE=${calibration_heapsize} \
+		EASYSANDBOX_STATSFD=3 ${refexe} < ${input} > ${output} 2> /dev/null 3> ${stats} ; } 2> ${times}
+	rc=$?
+
+	heappeak=`awk '$1 == "heappeak" { print $2 }' ${stats}`
+	heapfull=`awk '$1 == "heapfull" { print $2 }' ${stats}`
+
+	# An oracle from a reference solution that crashed, was killed,
+	# or ran out of heap is almost certainly wrong
+	failed=0
+	if [ ${rc} -gt 128 ]; then
+		echo "${casename}: error: reference solution exited with code ${rc} > 128 (probably signal `expr ${rc} - 128`)" >&2
+		failed=1
+	fi
+	if [ "${heapfull}" = 1 ] || [ "${heappeak:-0}" -ge ${calibration_heapsize} ]; then
+		echo "${casename}: error: reference solution ran out of heap (${calibration_heapsize} bytes); set EASYSANDBOX_HEAPSIZE to calibrate with a larger heap" >&2
+		failed=1
+	fi
+	if [ ${failed} != 0 ]; then
+		echo "${casename}: oracle files not written" >&2
+		rm -f ${stats} ${times} ${output}
+		return 1
+	fi
+
+	# A process that exits without calling exit (e.g., via _exit)
+	# never reports its heap usage, so fall back to the calibration heap size
+	if [ -z "${heappeak}" ]; then
+		heappeak=${calibration_heapsize}
+	fi
+
+	heapsize=`awk -v peak=${heappeak} -v f=${heapfactor} -v g=${heap_granularity} \
+		'BEGIN { n = int((peak * f + g - 1) / g); print n * g }'`
+
+	timelimit=`tail -n 1 ${times} | awk -v f=${timefactor} -v min=${min_timelimit} \
+		'{ t = ($1 + $2) * f; n = int(t); if (n < t) n++; if (n < min) n = min; print n }'`
+
+	cat ${output} > ${casename}.out
+	echo ${rc} > ${casename}.exit
+	echo ${heapsize} > ${casename}.heapsize
+	echo ${timelimit} > ${casename}.timelimit
+
+	echo "${casename}: exit ${rc}, heap ${heapsize}, time limit ${timelimit}s"
+	rm -f ${stats} ${times} ${output}
+	return 0
+}
+
+# Each case is a pair: the case name and its stdin.  Without explicit
+# inputs, the single case for refexe may or may not have an input file.
+cases=""
+if [ $# -eq 0 ]; then
+	casename=oracle/`basename ${refexe}`
+	if [ -r ${casename}.in ]; then
+		cases="${casename} ${casename}.in"
+	else
+		cases="${casename} /dev/null"
+	fi
+else
+	for input in "$@"; do
+		case ${input} in
+		*.in) ;;
+		*) echo "$0: error: input file ${input} does not end in .in" >&2
+		   exit 1 ;;
+		esac
+		if [ ! -r ${input} ]; then
+			echo "$0: error: can't read input file ${input}" >&2
+			exit 1
+		fi
+		cases="${cases} ${input%.in} ${input}"
+	done
+fi
+
+running=0
+errors=0
+set -- ${cases}
+while [ $# -gt 0 ]; do
+	if [ ${running} -ge ${jobs} ]; then
+		wait -n || errors=`expr ${errors} + 1`
+		running=`expr ${running} - 1`
+	fi
+	run_case $1 $2 &
+	running=`expr ${running} + 1`
+	shift 2
+done
+while [ ${running} -gt 0 ]; do
+	wait -n || errors=`expr ${errors} + 1`
+	running=`expr ${running} - 1`
+done
+
+if [ ${errors} != 0 ]; then
+	echo "${errors} case(s) failed: their oracle files were not written" >&2
+	exit 1
+fi
+exit 0
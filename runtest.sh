@@ -7,15 +7,35 @@ echo -n "Executing ${testexe}..."
 
 input=oracle/${testname}.in
 actual=/tmp/actual$$
+actual_err=/tmp/actual_err$$
 expected=oracle/${testname}.out
 
-if [ ! -r oracle/${testname}.in ]; then
+# Use calibrated limits (see mkoracle.sh) if the test has them
+if [ -r oracle/${testname}.heapsize ]; then
+	EASYSANDBOX_HEAPSIZE=`cat oracle/${testname}.heapsize`
+	export EASYSANDBOX_HEAPSIZE
+fi
+if [ -r oracle/${testname}.stacksize ]; then
+	EASYSANDBOX_STACKSIZE=`cat oracle/${testname}.stacksize`
+	export EASYSANDBOX_STACKSIZE
+fi
+timelimit=unlimited
+if [ -r oracle/${testname}.timelimit ]; then
+	timelimit=`cat oracle/${testname}.timelimit`
+fi
+
+if [ -r oracle/${testname}.interactor ]; then
+	# Test talks to an interactor, which decides whether it passes
+	interactor=`cat oracle/${testname}.interactor`
+	(ulimit -t ${timelimit}; EASYSANDBOX_SO=./EasySandbox.so exec ./interact ${interactor} -- ./${testexe}) > ${actual} 2> ${actual_err}
+	testexe_rc=$?
+elif [ ! -r oracle/${testname}.in ]; then
 	# Test does not expect input
-	LD_PRELOAD=./EasySandbox.so ./${testexe} > ${actual} 2> /dev/null
+	(ulimit -t ${timelimit}; LD_PRELOAD=./EasySandbox.so exec ./${testexe}) > ${actual} 2> ${actual_err}
 	testexe_rc=$?
 else
 	# Test expects input from stdin
-	LD_PRELOAD=./EasySandbox.so ./${testexe} < ${input} > ${actual} 2> /dev/null
+	(ulimit -t ${timelimit}; LD_PRELOAD=./EasySandbox.so exec ./${testexe}) < ${input} > ${actual} 2> ${actual_err}
 	testexe_rc=$?
 fi
 diff ${actual} ${expected}
@@ -24,10 +44,24 @@ diff_rc=$?
 actual_output=`cat ${actual}`
 rm -f ${actual}
 if [ $diff_rc != 0 ]; then
+	rm -f ${actual_err}
 	echo "failed (output mismatch, expected [`cat ${expected}`], got [${actual_output}])"
 	exit 1
 fi
 
+# Each line of the .err file, if any, is an extended regular
+# expression that some line of the test's stderr must match
+if [ -r oracle/${testname}.err ]; then
+	while read -r pattern; do
+		if ! grep -E -q -e "${pattern}" ${actual_err}; then
+			echo "failed (no line of stderr matches [${pattern}], got [`cat ${actual_err}`])"
+			rm -f ${actual_err}
+			exit 1
+		fi
+	done < oracle/${testname}.err
+fi
+rm -f ${actual_err}
+
 expected_rc=`cat oracle/${testname}.exit`
 if [ $testexe_rc != $expected_rc ]; then
 	echo "failed (exit code mismatch, expected ${expected_rc}, got ${testexe_rc})"
@@ -0,0 +1,14 @@
+#! /bin/bash
+
+# Interactor for test18: sends 1000 queries "a b", one at a time,
+# and checks that each answer is a+b.  Gives up if an answer takes
+# more than 5 seconds (e.g., because it is stuck in a buffer).
+
+for ((i = 1; i <= 1000; i++)); do
+	echo "$i `expr $i \* 7`"
+	read -t 5 answer || exit 1
+	if [ "${answer}" != `expr $i \* 8` ]; then
+		exit 1
+	fi
+done
+exit 0
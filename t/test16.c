@@ -0,0 +1,13 @@
+/* Test that a crashing program's buffered output is flushed
+ * by the crash handler, and that it exits with the same exit code
+ * as if it had been killed by SIGSEGV. */
+
+#include <stdio.h>
+
+int main(void) {
+	volatile int *p = 0;
+	printf("About to crash\n");
+	*p = 42;
+	printf("Should not get here\n");
+	return 0;
+}
@@ -0,0 +1,21 @@
+/* Test that deep recursion works when main runs on a large
+ * preallocated stack (see oracle/test17.stacksize).  With the
+ * default 8MB stack, this would overflow the stack. */
+
+#include <stdio.h>
+
+#define DEPTH 1000000
+
+static long depth(long n) {
+	volatile char frame[32];
+	frame[0] = (char) n;
+	if (n == 0) {
+		return 0;
+	}
+	return depth(n - 1) + 1 + frame[0] - (char) n;
+}
+
+int main(void) {
+	printf("%ld\n", depth(DEPTH));
+	return 0;
+}
@@ -0,0 +1,15 @@
+/* Test interactive mode: answer each query from the interactor
+ * (t/judge18.sh) with a line of output.  This relies on stdout being
+ * line buffered, and on stdin being readable in SECCOMP mode without
+ * the usual nonblocking probe. */
+
+#include <stdio.h>
+
+int main(void) {
+	int a, b;
+
+	while (scanf("%d %d", &a, &b) == 2) {
+		printf("%d\n", a + b);
+	}
+	return 0;
+}
@@ -0,0 +1,14 @@
+/* Test that a failed assertion is reported, with the output
+ * produced so far, even though glibc's abort can't run in
+ * SECCOMP mode. */
+
+#include <stdio.h>
+#include <assert.h>
+
+int main(void) {
+	int x = 1;
+	printf("Checking x\n");
+	assert(x == 2);
+	printf("Should not get here\n");
+	return 0;
+}
@@ -0,0 +1,13 @@
+/* Test that calling through a null function pointer produces
+ * a backtrace, even though the unwinder can't unwind from
+ * address 0. */
+
+#include <stdio.h>
+
+void (*volatile fn)(void);
+
+int main(void) {
+	printf("Calling fn\n");
+	fn();
+	return 0;
+}
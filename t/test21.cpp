@@ -0,0 +1,14 @@
+// Test that an uncaught C++ exception is reported as a call to
+// abort when main runs on the preallocated stack (see
+// oracle/test21.stacksize): the exception unwinder must stop at
+// the bottom of that stack rather than crash.
+
+#include <cstdio>
+#include <stdexcept>
+
+int main(void)
+{
+	printf("Throwing\n");
+	throw std::runtime_error("uncaught");
+	return 0;
+}